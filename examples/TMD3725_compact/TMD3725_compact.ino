@@ -0,0 +1,58 @@
+#include <Wire.h>
+#include <TMD3725.h>
+#include <Arduino.h>
+
+#define TCA9544ADDR 0x70
+
+#ifndef SENSOR_COUNT
+#define SENSOR_COUNT 4            // one TMD3725 on each TCA9544A channel
+#endif
+
+TMD3725 tmd3725;
+optics_val colordata;
+
+//REDIRECT_STDOUT_TO(Serial);
+#ifdef TMD3725_INT_REGS
+// previous per-sensor storage, built by extras/size_report.sh for comparison
+int reginfo[SENSOR_COUNT][35];
+int colorarray[SENSOR_COUNT][9];
+#else
+uint8_t reginfo[SENSOR_COUNT][TMD3725_REGCOUNT];
+tmd3725_raw raw[SENSOR_COUNT];
+#endif
+
+void select_channel(uint8_t channel) {
+  Wire.beginTransmission(TCA9544ADDR);
+  Wire.write(0x04 | channel);     // enable bit + channel number
+  Wire.endTransmission();
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("TMD3725 compact storage example\n");
+  Wire.begin();
+
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    select_channel(i);
+    if (tmd3725.begin())
+      tmd3725.init(reginfo[i]);
+    else
+      Serial.println("tmd3725 not connected");
+  }
+}
+
+void loop() {
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    select_channel(i);
+    tmd3725.get_all_data(reginfo[i]);
+#ifdef TMD3725_INT_REGS
+    tmd3725.get_optics_data(colorarray[i]);
+    colordata = tmd3725.calib_color(colorarray[i], reginfo[i]);
+#else
+    tmd3725.get_raw_data(raw[i]);
+    colordata = tmd3725.calib_color(raw[i], reginfo[i]);
+#endif
+    tmd3725.print_color_json(colordata, millis());
+  }
+  delay(1000);                      // wait for a second
+}
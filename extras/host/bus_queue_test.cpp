@@ -0,0 +1,152 @@
+/*
+ * Host test of I2CBusQueue with threads and a simulated bus.
+ *
+ * Build and run from the library root:
+ *   g++ -std=c++11 -O1 -g -fsanitize=thread -Isrc extras/host/bus_queue_test.cpp src/TMD3725.cpp src/I2CBusQueue.cpp src/LinuxI2CBus.cpp -o bus_queue_test -pthread
+ *   ./bus_queue_test
+ *
+ * Checks that transactions never overlap on the bus, that register reads of
+ * several TMD3725 instances sharing one queue return the right data, that
+ * batches reach I2CBus::execute_batch() whole, and that waiting transactions
+ * run by priority, FIFO within a priority.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TMD3725.h"
+
+#define THREADS     8
+#define ITERATIONS  2000
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) failures++;
+}
+
+/*
+ * Simulated bus with a register file per address that auto-increments on
+ * burst access. It counts overlapping execute() calls and records the
+ * address of every transaction in execution order.
+ */
+class SimBus : public I2CBus
+{
+private:
+	std::atomic<int> _inside;
+	std::mutex _log_mutex;
+	uint8_t _regs[128][256];
+
+public:
+	std::atomic<int> overlaps;
+	std::atomic<int> batches;   // execute_batch() calls with more than one transaction
+	std::atomic<bool> hold;     // the next transaction on address 0x10 blocks while set
+	std::atomic<bool> holding;
+	std::vector<uint8_t> order;
+
+	SimBus() : _inside(0), overlaps(0), batches(0), hold(false), holding(false)
+	{
+		for (int a = 0; a < 128; a++)
+			for (int r = 0; r < 256; r++)
+				_regs[a][r] = (uint8_t)(a + r);
+	}
+
+	uint8_t reg(uint8_t address, uint8_t r) { return _regs[address][r]; }
+
+	int execute_batch(i2c_transaction t[], uint8_t n)
+	{
+		if (n > 1) batches++;
+		return I2CBus::execute_batch(t, n);
+	}
+
+	int execute(i2c_transaction& t)
+	{
+		if (_inside.fetch_add(1) != 0) overlaps++;
+		{
+			std::lock_guard<std::mutex> guard(_log_mutex);
+			order.push_back(t.address);
+		}
+		if (t.address == 0x10) {
+			holding = true;
+			while (hold) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::microseconds(5));
+		}
+		if (t.tx_len) {
+			uint8_t p = t.tx[0];
+			for (uint8_t i = 1; i < t.tx_len; i++) _regs[t.address][(uint8_t)(p + i - 1)] = t.tx[i];
+			for (uint8_t i = 0; i < t.rx_len; i++) t.rx[i] = _regs[t.address][(uint8_t)(p + i)];
+		}
+		_inside--;
+		return 0;
+	}
+};
+
+static void test_shared_sensors() {
+    SimBus bus;
+    I2CBusQueue queue(bus);
+    std::atomic<int> errors(0);
+    std::vector<std::thread> threads;
+
+    for (int k = 0; k < THREADS; k++) {
+        threads.push_back(std::thread([&]() {
+            TMD3725 tmd3725(bus);
+            uint8_t reginfo[TMD3725_REGCOUNT];
+            tmd3725_raw raw;
+            tmd3725.set_bus_queue(&queue);
+            for (int n = 0; n < ITERATIONS; n++) {
+                if (tmd3725.get_all_data(reginfo) != 0) errors++;
+                if (reginfo[TMD3725_REGCOUNT - 1] != bus.reg(TMD3725ADDR, INTENAB_ADDR)) errors++;
+                if (tmd3725.get_raw_data(raw) != 0) errors++;
+                if (raw.prox != bus.reg(TMD3725ADDR, PDATA_ADDR)) errors++;
+            }
+        }));
+    }
+    for (size_t k = 0; k < threads.size(); k++) threads[k].join();
+
+    check(bus.overlaps == 0, "no overlapping transactions");
+    check(errors == 0, "register data of shared sensors");
+    check(bus.batches == THREADS * ITERATIONS, "get_all_data() reaches the bus as one batch");
+}
+
+static void test_priority_order() {
+    SimBus bus;
+    I2CBusQueue queue(bus);
+    std::vector<std::thread> threads;
+    uint8_t blocker = 0;
+
+    // keep the bus busy while the other transactions queue up
+    bus.hold = true;
+    threads.push_back(std::thread([&]() { queue.write(0x10, &blocker, 1, I2C_PRIO_BULK); }));
+    while (!bus.holding) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    const uint8_t address[] = { 0x20, 0x21, 0x22, 0x23, 0x24 };
+    const uint8_t priority[] = { I2C_PRIO_BULK, I2C_PRIO_NORMAL, I2C_PRIO_SENSOR, I2C_PRIO_BULK, I2C_PRIO_SENSOR };
+    for (int i = 0; i < 5; i++) {
+        threads.push_back(std::thread([&, i]() {
+            uint8_t rx;
+            uint8_t reg = 0;
+            queue.write_read(address[i], &reg, 1, &rx, 1, priority[i]);
+        }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));    // fixes submission order
+    }
+    bus.hold = false;
+    for (size_t k = 0; k < threads.size(); k++) threads[k].join();
+
+    const uint8_t expected[] = { 0x10, 0x22, 0x24, 0x21, 0x20, 0x23 };
+    check(bus.order.size() == sizeof(expected) && !memcmp(&bus.order[0], expected, sizeof(expected)),
+          "priority order, FIFO within a priority");
+    check(bus.overlaps == 0, "no overlapping transactions while queued");
+}
+
+int main() {
+    test_shared_sensors();
+    test_priority_order();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Host test of the deadband output (deadband_check(), print_color_delta(),
+ * suppression_ratio()) with samples built from hsv colors.
+ *
+ * Build and run from the library root:
+ *   g++ -std=c++11 -O1 -g -Isrc extras/host/deadband_test.cpp src/TMD3725.cpp src/I2CBusQueue.cpp src/LinuxI2CBus.cpp -o deadband_test -pthread
+ *   ./deadband_test
+ *
+ * Checks the first record, suppression inside the deadbands, hue wrap across
+ * 0/360, sub-deadband drift adding up until it is emitted, heartbeat expiry
+ * in delta and full record mode across the uint32_t timestamp wraparound, and
+ * the suppression ratio.
+ */
+
+#include <stdio.h>
+#include "TMD3725.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) failures++;
+}
+
+// no sensor is read, deadband_check() only works on calibrated samples
+class NullBus : public I2CBus
+{
+public:
+	int execute(i2c_transaction& t) { (void)t; return 0; }
+};
+
+static NullBus bus;
+static TMD3725 tmd3725(bus);
+
+// calibrated sample of the given color, deadband_check() scales red/green/blue by 1/50
+static optics_val sample(double h, double s, double v, float lux) {
+    hsv in = { h, s, v };
+    rgb out = tmd3725.hsv2rgb(in);
+    optics_val color_data = optics_val();
+    color_data.red = out.r * 50;
+    color_data.green = out.g * 50;
+    color_data.blue = out.b * 50;
+    color_data.Lux = lux;
+    return color_data;
+}
+
+static void test_first_and_suppression() {
+    tmd3725_deadband db;
+    hsv color;
+    tmd3725.init_deadband(db, 5, 0.05, 0.05, 10, 0, 1);
+
+    int flags = tmd3725.deadband_check(db, sample(120, 0.5, 0.5, 100), 0, color);
+    check(flags == (DB_FULL | DB_HUE | DB_SAT | DB_VAL | DB_LUX), "first sample is a full record");
+    check(tmd3725.deadband_check(db, sample(123, 0.53, 0.47, 108), 10, color) == 0,
+          "changes inside every deadband are suppressed");
+    check(tmd3725.deadband_check(db, sample(120, 0.5, 0.5, 115), 20, color) == DB_LUX,
+          "only the field out of its deadband is emitted");
+    check(tmd3725.deadband_check(db, sample(140, 0.5, 0.5, 115), 30, color) == DB_HUE,
+          "hue change out of the deadband");
+}
+
+static void test_hue_wrap() {
+    tmd3725_deadband db;
+    hsv color;
+    tmd3725.init_deadband(db, 5, 0.05, 0.05, 10, 0, 1);
+
+    tmd3725.deadband_check(db, sample(359, 0.8, 0.8, 100), 0, color);
+    check(tmd3725.deadband_check(db, sample(1, 0.8, 0.8, 100), 10, color) == 0,
+          "hue 359 -> 1 is a 2 degree change, suppressed");
+    check(tmd3725.deadband_check(db, sample(10, 0.8, 0.8, 100), 20, color) == DB_HUE,
+          "hue 359 -> 10 across 0 is emitted");
+    check(tmd3725.deadband_check(db, sample(357, 0.8, 0.8, 100), 30, color) == DB_HUE,
+          "hue 10 -> 357 across 0 is emitted");
+}
+
+static void test_drift() {
+    tmd3725_deadband db;
+    hsv color;
+    tmd3725.init_deadband(db, 5, 0.05, 0.05, 10, 0, 1);
+
+    tmd3725.deadband_check(db, sample(200, 0.5, 0.50, 100), 0, color);
+    int first = tmd3725.deadband_check(db, sample(200, 0.5, 0.52, 100), 10, color);
+    int second = tmd3725.deadband_check(db, sample(200, 0.5, 0.54, 100), 20, color);
+    int third = tmd3725.deadband_check(db, sample(200, 0.5, 0.56, 100), 30, color);
+    check(first == 0 && second == 0 && third == DB_VAL, "drift below the deadband adds up until it is emitted");
+    check(tmd3725.deadband_check(db, sample(200, 0.5, 0.60, 100), 40, color) == 0,
+          "emitted value is the new reference");
+}
+
+static void test_heartbeat() {
+    tmd3725_deadband db;
+    hsv color;
+    const uint32_t t0 = 0xFFFFFF00;     // heartbeat runs across the uint32_t wraparound
+
+    // delta mode: only full records restart the heartbeat
+    tmd3725.init_deadband(db, 5, 0.05, 0.05, 10, 1000, 1);
+    tmd3725.deadband_check(db, sample(60, 0.5, 0.5, 100), t0, color);
+    check(tmd3725.deadband_check(db, sample(60, 0.5, 0.5, 100), t0 + 999, color) == 0,
+          "delta mode: unchanged sample before the heartbeat is suppressed");
+    check(tmd3725.deadband_check(db, sample(60, 0.5, 0.5, 100), t0 + 1000, color) & DB_FULL,
+          "delta mode: heartbeat expires across the timestamp wrap");
+    check(tmd3725.deadband_check(db, sample(90, 0.5, 0.5, 100), t0 + 1500, color) == DB_HUE,
+          "delta mode: change emits a delta record");
+    check(tmd3725.deadband_check(db, sample(90, 0.5, 0.5, 100), t0 + 2000, color) & DB_FULL,
+          "delta mode: delta records do not restart the heartbeat");
+
+    // full record mode: every emitted record restarts the heartbeat
+    tmd3725.init_deadband(db, 5, 0.05, 0.05, 10, 1000, 0);
+    tmd3725.deadband_check(db, sample(60, 0.5, 0.5, 100), t0, color);
+    int flags = tmd3725.deadband_check(db, sample(90, 0.5, 0.5, 100), t0 + 600, color);
+    check(flags == (DB_HUE | DB_SAT | DB_VAL | DB_LUX), "full mode: change emits every field");
+    check(tmd3725.deadband_check(db, sample(90, 0.5, 0.5, 100), t0 + 1599, color) == 0,
+          "full mode: heartbeat restarts on the emitted record");
+    check(tmd3725.deadband_check(db, sample(90, 0.5, 0.5, 100), t0 + 1600, color) & DB_FULL,
+          "full mode: heartbeat expires across the timestamp wrap");
+}
+
+static void test_suppression_ratio() {
+    tmd3725_deadband db;
+    tmd3725.init_deadband(db, 5, 0.05, 0.05, 10, 0, 1);
+    check(tmd3725.suppression_ratio(db) == 0, "suppression ratio is 0 before the first sample");
+
+    float hue = tmd3725.print_color_delta(db, sample(180, 0.5, 0.5, 100), 0);
+    bool suppressed = true;
+    for (int i = 1; i <= 3; i++) {
+        suppressed &= tmd3725.print_color_delta(db, sample(181, 0.5, 0.5, 101), i * 10) == -1;
+    }
+    check(hue > 179 && hue < 181 && suppressed, "print_color_delta() returns the hue, -1 when suppressed");
+    check(db.emitted == 1 && db.suppressed == 3 && tmd3725.suppression_ratio(db) == 0.75f,
+          "suppression ratio 1 emitted / 3 suppressed");
+}
+
+int main() {
+    test_first_and_suppression();
+    test_hue_wrap();
+    test_drift();
+    test_heartbeat();
+    test_suppression_ratio();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+#!/bin/sh
+# RAM/flash footprint of examples/TMD3725_compact before and after the compact
+# register storage, in total and per sensor.
+#
+#   before    - library as it was before the bus queue / compact storage series
+#               (extracted from git), sketch with int reginfo[35] + int colorarray[9]
+#   after-int - current library, same int arrays in the sketch
+#   after     - current library, uint8_t reginfo[TMD3725_REGCOUNT] + tmd3725_raw
+#
+# Totals include the library itself (TMD3725 object, vtables in .data on AVR,
+# code); the per-sensor columns come from building 1 and 4 sensors. Stack use is
+# not part of the static numbers.
+#
+# Usage: extras/size_report.sh [fqbn] [base revision]
+#   fqbn            default arduino:avr:nano
+#   base revision   git revision of the "before" library, default is the parent
+#                   of the commit that added src/I2CBusQueue.h
+# Needs git and arduino-cli with the core for the board installed.
+
+FQBN=${1:-arduino:avr:nano}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SKETCH="$ROOT/examples/TMD3725_compact"
+BASE=${2:-$(git -C "$ROOT" log --diff-filter=A --format=%H -- src/I2CBusQueue.h | tail -n 1)^}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+mkdir -p "$WORK/base/TMD3725"
+if ! git -C "$ROOT" archive "$BASE" | tar -x -C "$WORK/base/TMD3725"; then
+    echo "can not extract base library $BASE" >&2
+    exit 1
+fi
+
+# build <library dir> <extra flags> <build dir>: prints "<flash bytes> <ram bytes>"
+build() {
+    arduino-cli compile --fqbn "$FQBN" --library "$1" --build-path "$WORK/$3" \
+        --build-property "compiler.cpp.extra_flags=$2" "$SKETCH" 2>&1 |
+    sed -n -e 's/^Sketch uses \([0-9]*\) bytes.*/\1/p' -e 's/^Global variables use \([0-9]*\) bytes.*/\1/p' |
+    tr '\n' ' '
+}
+
+# report <name> <library dir> <extra flags>
+report() {
+    set -- "$1" $(build "$2" "$3 -DSENSOR_COUNT=1" "$1-1") $(build "$2" "$3 -DSENSOR_COUNT=4" "$1-4")
+    if [ $# -ne 5 ]; then
+        echo "build failed for $1" >&2
+        exit 1
+    fi
+    printf "%-10s %10s %10s %14s %14s\n" $1 $2 $3 $((($4 - $2) / 3)) $((($5 - $3) / 3))
+}
+
+echo "fqbn $FQBN, before = $(git -C "$ROOT" rev-parse --short "$BASE")"
+printf "%-10s %10s %10s %14s %14s\n" build flash ram flash/sensor ram/sensor
+report before "$WORK/base/TMD3725" "-DTMD3725_INT_REGS"
+report after-int "$ROOT" "-DTMD3725_INT_REGS"
+report after "$ROOT" ""
@@ -0,0 +1,261 @@
+/* MIT License
+ * Copyright (c) 2024 Vasilii Zhuravskii zhuravsky.cc
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ */
+
+#include "I2CBusQueue.h"
+
+int I2CBus::execute_batch(i2c_transaction t[], uint8_t n) {
+    /*
+     * FUNCTION: Run several transactions in order, default is one execute() per transaction
+     * ---------
+     * INPUT: t[n] - transactions to run, status of each one is updated
+     * RETURN: 0 - success
+     *         -1 - at least one transaction failed
+     */
+    int rc = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        t[i].status = (execute(t[i]) == 0) ? I2C_OK : I2C_ERROR;
+        if (t[i].status != I2C_OK) rc = -1;
+    }
+    return rc;
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+int TwoWireBus::execute(i2c_transaction& t) {
+    /*
+     * FUNCTION: Run one transaction on the Arduino TwoWire port
+     * ---------
+     * INPUT: t - transaction to run, rx[] is filled on success
+     * RETURN: 0 - success
+     *         -1 - error (NACK or short read)
+     */
+    _wire->beginTransmission(t.address);
+    if (t.tx_len) _wire->write(t.tx, t.tx_len);
+    if (_wire->endTransmission(t.rx_len == 0) != 0) {
+        return -1;      // no ACK
+    }
+    if (t.rx_len == 0) {
+        return 0;
+    }
+    if (_wire->requestFrom((uint8_t)t.address, (uint8_t)t.rx_len) != t.rx_len) {
+        while (_wire->available()) _wire->read();
+        return -1;
+    }
+    for (uint8_t i = 0; i < t.rx_len; i++) {
+        t.rx[i] = _wire->read();
+    }
+    return 0;
+}
+#endif
+
+I2CBusQueue::I2CBusQueue(I2CBus& bus) : _bus(bus), _count(0), _busy(false), _seq(0)
+#if defined(I2C_QUEUE_MBED)
+    , _cv(_mutex)
+#endif
+{
+#if defined(I2C_QUEUE_FREERTOS)
+    _mutex = xSemaphoreCreateMutex();
+    _wake = xSemaphoreCreateCounting(I2C_QUEUE_WAITERS, 0);
+    _waiters = 0;
+#elif defined(I2C_QUEUE_PICO)
+    mutex_init(&_mutex);
+    sem_init(&_wake, 0, I2C_QUEUE_WAITERS);
+    _waiters = 0;
+#endif
+}
+
+/*
+ * Locking primitives. On the host std::mutex/condition_variable are used, on
+ * mbed rtos::Mutex/ConditionVariable. FreeRTOS and the pico-sdk (safe across
+ * both RP2040 cores) have no condition variable, there wait() counts itself
+ * in _waiters and blocks on a counting semaphore after releasing the mutex,
+ * and notify() releases one count per waiter. A count released before the
+ * waiter blocks is kept by the semaphore, so no wake-up is lost. AVR and
+ * ESP8266 run the sketch in a single thread, so the bus is always free when
+ * a transaction is submitted and no locking is needed.
+ */
+void I2CBusQueue::lock() {
+#if defined(I2C_QUEUE_STD)
+    _mutex.lock();
+#elif defined(I2C_QUEUE_FREERTOS)
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+#elif defined(I2C_QUEUE_MBED)
+    _mutex.lock();
+#elif defined(I2C_QUEUE_PICO)
+    mutex_enter_blocking(&_mutex);
+#endif
+}
+
+void I2CBusQueue::unlock() {
+#if defined(I2C_QUEUE_STD)
+    _mutex.unlock();
+#elif defined(I2C_QUEUE_FREERTOS)
+    xSemaphoreGive(_mutex);
+#elif defined(I2C_QUEUE_MBED)
+    _mutex.unlock();
+#elif defined(I2C_QUEUE_PICO)
+    mutex_exit(&_mutex);
+#endif
+}
+
+void I2CBusQueue::wait() {
+#if defined(I2C_QUEUE_STD)
+    _cv.wait(_mutex);
+#elif defined(I2C_QUEUE_FREERTOS)
+    _waiters++;
+    xSemaphoreGive(_mutex);
+    xSemaphoreTake(_wake, portMAX_DELAY);
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+#elif defined(I2C_QUEUE_MBED)
+    _cv.wait();
+#elif defined(I2C_QUEUE_PICO)
+    _waiters++;
+    mutex_exit(&_mutex);
+    sem_acquire_blocking(&_wake);
+    mutex_enter_blocking(&_mutex);
+#else
+    yield();
+#endif
+}
+
+void I2CBusQueue::notify() {
+#if defined(I2C_QUEUE_STD)
+    _cv.notify_all();
+#elif defined(I2C_QUEUE_FREERTOS)
+    for (; _waiters; _waiters--) {
+        xSemaphoreGive(_wake);
+    }
+#elif defined(I2C_QUEUE_MBED)
+    _cv.notify_all();
+#elif defined(I2C_QUEUE_PICO)
+    for (; _waiters; _waiters--) {
+        sem_release(&_wake);
+    }
+#endif
+}
+
+I2CBusQueue::queue_entry I2CBusQueue::pop_next() {
+    /*
+     * FUNCTION: Remove and return the next transaction to run, the lock must be held
+     * ---------
+     * RETURN: highest priority entry, oldest first among equal priorities
+     */
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < _count; i++) {
+        if ((_pending[i].priority > _pending[best].priority) ||
+            ((_pending[i].priority == _pending[best].priority) &&
+             ((int32_t)(_pending[i].seq - _pending[best].seq) < 0))) {
+            best = i;
+        }
+    }
+    queue_entry next = _pending[best];
+    _pending[best] = _pending[--_count];
+    return next;
+}
+
+int I2CBusQueue::submit(i2c_transaction& t) {
+    /*
+     * FUNCTION: Queue a transaction and block until it has been executed
+     * ---------
+     * INPUT: t - complete transaction, buffers must stay valid until return
+     * RETURN: 0 - success
+     *         -1 - error
+     */
+    return submit_batch(&t, 1);
+}
+
+int I2CBusQueue::submit_batch(i2c_transaction t[], uint8_t n) {
+    /*
+     * FUNCTION: Queue n transactions as one entry and block until they have been executed
+     * ---------
+     * INPUT: t[n] - complete transactions, buffers must stay valid until return
+     * RETURN: 0 - success
+     *         -1 - at least one transaction failed
+     *
+     * There is no worker thread: whichever submitter finds the bus idle runs
+     * the next entry in priority order, which may belong to another task.
+     * Each entry is executed with the bus held exclusively, so its writes and
+     * repeated-start reads can not interleave with other drivers, and a batch
+     * goes to I2CBus::execute_batch() whole, so combining backends still send
+     * it in one bus access.
+     */
+    int result = I2C_PENDING;
+    if (n == 0) {
+        return 0;
+    }
+    lock();
+    while (_count == I2C_QUEUE_DEPTH) {
+        wait();
+    }
+    queue_entry& entry = _pending[_count++];
+    entry.t = t;
+    entry.n = n;
+    entry.priority = t[0].priority;
+    entry.seq = _seq++;
+    entry.result = &result;
+    while (result == I2C_PENDING) {
+        if (_busy) {
+            wait();
+            continue;
+        }
+        queue_entry next = pop_next();
+        _busy = true;
+        unlock();
+        int rc;
+        if (next.n == 1) {
+            rc = _bus.execute(next.t[0]);
+            next.t[0].status = (rc == 0) ? I2C_OK : I2C_ERROR;
+        }
+        else {
+            rc = _bus.execute_batch(next.t, next.n);
+        }
+        lock();
+        *next.result = (rc == 0) ? I2C_OK : I2C_ERROR;
+        _busy = false;
+        notify();
+    }
+    unlock();
+    return result;
+}
+
+int I2CBusQueue::write(uint8_t address, const uint8_t* tx, uint8_t tx_len, uint8_t priority) {
+    i2c_transaction t = { address, tx, tx_len, 0, 0, priority, I2C_PENDING };
+    return submit(t);
+}
+
+int I2CBusQueue::write_read(uint8_t address, const uint8_t* tx, uint8_t tx_len, uint8_t* rx, uint8_t rx_len, uint8_t priority) {
+    i2c_transaction t = { address, tx, tx_len, rx, rx_len, priority, I2C_PENDING };
+    return submit(t);
+}
+
+int I2CBusQueue::burst_read(uint8_t address, uint8_t reg, uint8_t* rx, uint8_t rx_len, uint8_t priority) {
+    /*
+     * FUNCTION: Set the register pointer and read rx_len consecutive registers in one transaction
+     * ---------
+     * INPUT: address - 7-bit device address
+     *        reg - first register address
+     *        rx - buffer for rx_len bytes
+     * RETURN: 0 - success
+     *         -1 - error
+     */
+    return write_read(address, &reg, 1, rx, rx_len, priority);
+}
@@ -0,0 +1,151 @@
+/* MIT License
+ * Copyright (c) 2024 Vasilii Zhuravskii zhuravsky.cc
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Shared I2C bus arbitration: drivers submit complete transactions that are
+ * executed one at a time, highest priority first, FIFO within a priority.
+ */
+
+#ifndef __I2CBUSQUEUE_H
+#define __I2CBUSQUEUE_H
+
+#include <stdint.h>
+
+// Locking used by I2CBusQueue, depends on how the platform runs concurrent tasks
+#if !defined(ARDUINO)
+#define I2C_QUEUE_STD           // host: std::mutex and condition_variable
+#include <mutex>
+#include <condition_variable>
+#elif defined(ESP32)
+#define I2C_QUEUE_FREERTOS      // FreeRTOS tasks
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#elif defined(ARDUINO_ARCH_MBED)
+#define I2C_QUEUE_MBED          // mbed RTOS threads (Arduino mbed cores, incl. Nano RP2040 Connect)
+#include <mbed.h>
+#elif defined(ARDUINO_ARCH_RP2040)
+#define I2C_QUEUE_PICO          // arduino-pico: setup1()/loop1() on the second core or FreeRTOS tasks
+#include <pico/mutex.h>
+#include <pico/sem.h>
+#elif defined(configUSE_PREEMPTION) || defined(INC_FREERTOS_H)
+#error "I2CBusQueue: no lock implementation for this multi-threaded core"
+#endif
+
+#ifdef ARDUINO
+#include <Wire.h>
+#endif
+
+#ifndef I2C_QUEUE_DEPTH
+#define I2C_QUEUE_DEPTH 8       // max transactions waiting for the bus at once
+#endif
+
+#define I2C_QUEUE_WAITERS   255 // max tasks blocked in one queue at once (FreeRTOS and RP2040 wake-up semaphore)
+
+// Transaction priorities, higher value runs first
+#define I2C_PRIO_BULK       0   // long writes (EEPROM pages, etc.)
+#define I2C_PRIO_NORMAL     1
+#define I2C_PRIO_SENSOR     2   // short periodic sensor reads
+
+// Transaction status
+#define I2C_OK              0
+#define I2C_ERROR           -1
+#define I2C_PENDING         1
+
+typedef struct i2c_transaction {
+    // One complete bus transaction: START, write tx[], then (if rx_len) a
+    // repeated START and read rx[], then STOP. tx_len = 0 with rx_len = 0 is
+    // an address probe. Buffers are owned by the submitter.
+    uint8_t address;
+    const uint8_t* tx;
+    uint8_t tx_len;
+    uint8_t* rx;
+    uint8_t rx_len;
+    uint8_t priority;
+    int status;
+} i2c_transaction;
+
+class I2CBus
+{
+public:
+	virtual ~I2CBus() {}
+	virtual int execute(i2c_transaction& t) = 0; // run one transaction on the wire, 0 - success, -1 - error
+	virtual int execute_batch(i2c_transaction t[], uint8_t n); // run n transactions, backends may combine them into one bus access
+};
+
+#ifdef ARDUINO
+class TwoWireBus : public I2CBus
+{
+private:
+	TwoWire* _wire;     // pointer, so TMD3725 objects holding a TwoWireBus stay assignable
+
+public:
+	TwoWireBus(TwoWire& wire = Wire) : _wire(&wire)
+	{
+	}
+
+	int execute(i2c_transaction& t);
+};
+#endif
+
+class I2CBusQueue
+{
+private:
+	typedef struct {
+		i2c_transaction* t;     // first transaction of the entry
+		uint8_t n;              // number of transactions, run back to back with the bus held
+		uint8_t priority;
+		uint32_t seq;           // submission order, FIFO within a priority
+		int* result;            // submitter's completion status, written under the lock
+	} queue_entry;
+
+	I2CBus& _bus;
+	queue_entry _pending[I2C_QUEUE_DEPTH];
+	uint8_t _count;
+	bool _busy;
+	uint32_t _seq;
+#if defined(I2C_QUEUE_STD)
+	std::mutex _mutex;
+	std::condition_variable_any _cv;
+#elif defined(I2C_QUEUE_FREERTOS)
+	SemaphoreHandle_t _mutex;
+	SemaphoreHandle_t _wake;    // counting semaphore, one count per task woken by notify()
+	uint8_t _waiters;
+#elif defined(I2C_QUEUE_MBED)
+	rtos::Mutex _mutex;
+	rtos::ConditionVariable _cv;
+#elif defined(I2C_QUEUE_PICO)
+	mutex_t _mutex;
+	semaphore_t _wake;          // one permit per task woken by notify()
+	uint8_t _waiters;
+#endif
+	void lock();
+	void unlock();
+	void wait();
+	void notify();
+	queue_entry pop_next();
+
+public:
+	I2CBusQueue(I2CBus& bus);
+
+	int submit(i2c_transaction& t); // queue a transaction and block until it has run, returns its status
+	int submit_batch(i2c_transaction t[], uint8_t n); // queue n transactions that run together through I2CBus::execute_batch(), priority of t[0]
+	int write(uint8_t address, const uint8_t* tx, uint8_t tx_len, uint8_t priority = I2C_PRIO_NORMAL);
+	int write_read(uint8_t address, const uint8_t* tx, uint8_t tx_len, uint8_t* rx, uint8_t rx_len, uint8_t priority = I2C_PRIO_NORMAL);
+	int burst_read(uint8_t address, uint8_t reg, uint8_t* rx, uint8_t rx_len, uint8_t priority = I2C_PRIO_NORMAL);
+};
+
+#endif // __I2CBUSQUEUE_H
@@ -0,0 +1,250 @@
+/* MIT License
+ * Copyright (c) 2024 Vasilii Zhuravskii zhuravsky.cc
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ */
+
+#include "LinuxI2CBus.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+bool LinuxI2CBus::begin() {
+    /*
+     * FUNCTION: Open the i2c-dev adapter and read its functionality flags
+     * ---------
+     * RETURN: true - success
+     *         false - adapter can not be opened
+     */
+    char path[32];
+    end();
+    snprintf(path, sizeof(path), "/dev/i2c-%d", _adapter);
+    _fd = open(path, O_RDWR);
+    if (_fd < 0) {
+        printf("I2C: Can not open %s\n", path);
+        return false;
+    }
+    _syscalls = 1;  // I2C_FUNCS
+    if (ioctl(_fd, I2C_FUNCS, &_funcs) < 0) {
+        _funcs = 0;
+    }
+    _smbus = !(_funcs & I2C_FUNC_I2C);
+    return true;
+}
+
+void LinuxI2CBus::end() {
+    if (_fd >= 0) {
+        close(_fd);
+    }
+    _fd = -1;
+    _slave = -1;
+}
+
+int LinuxI2CBus::set_slave(uint8_t address) {
+    /*
+     * FUNCTION: Select the slave address for read()/write() and SMBus calls, cached between calls
+     * ---------
+     * RETURN: 0 - success
+     *         -1 - error
+     */
+    if (_slave == address) {
+        return 0;
+    }
+    _syscalls++;
+    if (ioctl(_fd, I2C_SLAVE, address) < 0) {
+        _slave = -1;
+        return -1;
+    }
+    _slave = address;
+    return 0;
+}
+
+int LinuxI2CBus::execute_smbus(i2c_transaction& t) {
+    /*
+     * FUNCTION: Map a transaction onto a single SMBus command
+     * ---------
+     * INPUT: t - transaction to run, rx[] is filled on success
+     * RETURN: 0 - success
+     *         -1 - error or transaction shape has no SMBus equivalent
+     */
+    struct i2c_smbus_ioctl_data args;
+    union i2c_smbus_data data;
+    if (set_slave(t.address) != 0) {
+        return -1;
+    }
+    memset(&args, 0, sizeof(args));
+    args.data = &data;
+    if (t.rx_len == 0) {
+        args.read_write = I2C_SMBUS_WRITE;
+        if (t.tx_len == 0) {
+            args.size = I2C_SMBUS_QUICK;
+            args.data = 0;
+        }
+        else if (t.tx_len == 1) {
+            args.command = t.tx[0];
+            args.size = I2C_SMBUS_BYTE;
+            args.data = 0;
+        }
+        else if (t.tx_len == 2) {
+            args.command = t.tx[0];
+            args.size = I2C_SMBUS_BYTE_DATA;
+            data.byte = t.tx[1];
+        }
+        else if (t.tx_len - 1 <= I2C_SMBUS_BLOCK_MAX) {
+            args.command = t.tx[0];
+            args.size = I2C_SMBUS_I2C_BLOCK_DATA;
+            data.block[0] = t.tx_len - 1;
+            memcpy(&data.block[1], &t.tx[1], t.tx_len - 1);
+        }
+        else return -1;
+    }
+    else {
+        args.read_write = I2C_SMBUS_READ;
+        if (t.tx_len == 0 && t.rx_len == 1) {
+            args.size = I2C_SMBUS_BYTE;
+        }
+        else if (t.tx_len == 1 && t.rx_len == 1) {
+            args.command = t.tx[0];
+            args.size = I2C_SMBUS_BYTE_DATA;
+        }
+        else if (t.tx_len == 1 && t.rx_len <= I2C_SMBUS_BLOCK_MAX) {
+            args.command = t.tx[0];
+            args.size = I2C_SMBUS_I2C_BLOCK_DATA;
+            data.block[0] = t.rx_len;
+        }
+        else return -1;
+    }
+    _syscalls++;
+    if (ioctl(_fd, I2C_SMBUS, &args) < 0) {
+        return -1;
+    }
+    if (t.rx_len == 1) {
+        t.rx[0] = data.byte;
+    }
+    else if (t.rx_len > 1) {
+        memcpy(t.rx, &data.block[1], t.rx_len);
+    }
+    return 0;
+}
+
+int LinuxI2CBus::execute(i2c_transaction& t) {
+    /*
+     * FUNCTION: Run one transaction, write and repeated-start read go out as one I2C_RDWR call
+     * ---------
+     * INPUT: t - transaction to run, rx[] is filled on success
+     * RETURN: 0 - success
+     *         -1 - error
+     */
+    if (_fd < 0) {
+        return -1;
+    }
+    if (_smbus || (t.tx_len == 0 && t.rx_len == 0)) {
+        return execute_smbus(t);    // SMBus-only adapter or address probe (quick write)
+    }
+    if (!_combined) {
+        // one syscall per bus phase, STOP between write and read
+        if (set_slave(t.address) != 0) {
+            return -1;
+        }
+        if (t.tx_len) {
+            _syscalls++;
+            if (write(_fd, t.tx, t.tx_len) != t.tx_len) {
+                return -1;
+            }
+        }
+        if (t.rx_len) {
+            _syscalls++;
+            if (read(_fd, t.rx, t.rx_len) != t.rx_len) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    return execute_batch(&t, 1);
+}
+
+int LinuxI2CBus::execute_batch(i2c_transaction t[], uint8_t n) {
+    /*
+     * FUNCTION: Run n transactions as combined I2C_RDWR messages, up to I2C_RDWR_IOCTL_MAX_MSGS per ioctl
+     * ---------
+     * INPUT: t[n] - transactions to run, status of each one is updated
+     * RETURN: 0 - success
+     *         -1 - at least one transaction failed
+     *
+     * All messages of one ioctl are joined with repeated STARTs, so a batch
+     * is also atomic with respect to other users of the adapter.
+     */
+    if (_fd < 0 || _smbus || !_combined) {
+        return I2CBus::execute_batch(t, n);
+    }
+    struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+    struct i2c_rdwr_ioctl_data rdwr;
+    int rc = 0;
+    uint8_t first = 0;
+    while (first < n) {
+        uint8_t last = first;
+        int nmsgs = 0;
+        while (last < n) {
+            int need = (t[last].tx_len ? 1 : 0) + (t[last].rx_len ? 1 : 0);
+            if (need == 0 || nmsgs + need > I2C_RDWR_IOCTL_MAX_MSGS) {
+                break;
+            }
+            if (t[last].tx_len) {
+                msgs[nmsgs].addr = t[last].address;
+                msgs[nmsgs].flags = 0;
+                msgs[nmsgs].len = t[last].tx_len;
+                msgs[nmsgs].buf = (__u8*)t[last].tx;
+                nmsgs++;
+            }
+            if (t[last].rx_len) {
+                msgs[nmsgs].addr = t[last].address;
+                msgs[nmsgs].flags = I2C_M_RD;
+                msgs[nmsgs].len = t[last].rx_len;
+                msgs[nmsgs].buf = t[last].rx;
+                nmsgs++;
+            }
+            last++;
+        }
+        if (last == first) {
+            // address probe in the middle of a batch, run it on its own
+            t[first].status = (execute(t[first]) == 0) ? I2C_OK : I2C_ERROR;
+            if (t[first].status != I2C_OK) rc = -1;
+            first++;
+            continue;
+        }
+        rdwr.msgs = msgs;
+        rdwr.nmsgs = nmsgs;
+        _syscalls++;
+        int status = (ioctl(_fd, I2C_RDWR, &rdwr) == nmsgs) ? I2C_OK : I2C_ERROR;
+        if (status != I2C_OK) rc = -1;
+        for (uint8_t i = first; i < last; i++) {
+            t[i].status = status;
+        }
+        first = last;
+    }
+    return rc;
+}
+
+#endif // __linux__ && !ARDUINO
@@ -0,0 +1,63 @@
+/* MIT License
+ * Copyright (c) 2024 Vasilii Zhuravskii zhuravsky.cc
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Linux /dev/i2c-N transport. Transactions are sent as I2C_RDWR combined
+ * messages, a batch of transactions goes out in as few ioctl calls as the
+ * kernel message limit allows. Adapters without plain I2C support (such as
+ * the i2c-stub test module) are driven through the SMBus ioctl instead.
+ */
+
+#ifndef __LINUXI2CBUS_H
+#define __LINUXI2CBUS_H
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include "I2CBusQueue.h"
+
+class LinuxI2CBus : public I2CBus
+{
+private:
+	int _adapter;
+	int _fd;
+	bool _combined;
+	bool _smbus;
+	int _slave;
+	unsigned long _funcs;
+	unsigned long _syscalls;
+	int set_slave(uint8_t address);
+	int execute_smbus(i2c_transaction& t);
+
+public:
+	LinuxI2CBus(int adapter, bool combined = true) : _adapter(adapter), _fd(-1), _combined(combined),
+		_smbus(false), _slave(-1), _funcs(0), _syscalls(0)
+	{
+	}
+	~LinuxI2CBus() { end(); }
+
+	bool begin(); // open /dev/i2c-<adapter>, false on error
+	void end(); // close the adapter
+	int execute(i2c_transaction& t);
+	int execute_batch(i2c_transaction t[], uint8_t n);
+
+	unsigned long syscall_count() const { return _syscalls; } // ioctl(), read() and write() calls on the adapter since begin()
+	bool smbus_only() const { return _smbus; } // adapter has no I2C_RDWR support, SMBus fallback is in use
+};
+
+#endif // __linux__ && !ARDUINO
+
+#endif // __LINUXI2CBUS_H
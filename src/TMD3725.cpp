@@ -21,54 +21,78 @@
 
 #include "TMD3725.h"
 #include <stdio.h>
+#include <math.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#endif
+
+int TMD3725::I2CRun(i2c_transaction t[], uint8_t n) {
+    /*
+     * FUNCTION: Run register transactions on the bus queue if one is set, otherwise directly on the bus
+     * ---------
+     * INPUT: t[n] - transactions to run, the bus may combine them into one access
+     * RETURN: 0 - success
+     *         -1 - error
+     */
+    if (_queue) {
+        t[0].priority = _priority;
+        return _queue->submit_batch(t, n);
+    }
+    return _bus->execute_batch(t, n);
+}
 
 int TMD3725::I2CGetreg(unsigned char addr, int reg) {
     /*
      * FUNCTION: Read the register value in byte form and return the value 
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
+     * INPUT: addr - I2C address of the device
      *        reg - the register address that we are reading from
      * RETURN: value at the register is returned
      *         -1 - error
      */
-    unsigned char data = -1;
-    _i2cPort.beginTransmission(addr);
-	_i2cPort.write(reg);
-	_i2cPort.endTransmission(false);
-	_i2cPort.requestFrom(addr, 1);
-	//delay(1);
-	while (_i2cPort.available()) data = _i2cPort.read();
-	_i2cPort.endTransmission(true);
-	if (data >= 0) {
-		//printf("%02X: %02X \n", reg, data);
-		return data;
-	}
-	else {
-		printf("I2C: No data on 0x%02x address, 0x%02x register\n", addr, reg);
-		return -1;
-	}
+    uint8_t regaddr = reg;
+    uint8_t data;
+    i2c_transaction t = { addr, &regaddr, 1, &data, 1, _priority, I2C_PENDING };
+    if (I2CRun(&t, 1) != 0) {
+        printf("I2C: No data on 0x%02x address, 0x%02x register\n", addr, reg);
+        return -1;
+    }
+    return data;
 }
 
 int TMD3725::I2CSetreg (unsigned char addr, int reg, int value) {
 	/*
      * FUNCTION: Write value to the specific register 
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
+     * INPUT: addr - I2C address of the device
      *        reg - the register address that we are writing to
      *        value - the value that is written to the register
      * RETURN: 0 - success
      *         -1 - error
      */
-    _i2cPort.beginTransmission(addr);
-	_i2cPort.write(reg);
-	_i2cPort.write(value);
-	int error_code = _i2cPort.endTransmission();
-	if (error_code != 0)
-	{
-		printf("I2C: Communication error: %d \n", error_code);
-		return -1; // Device did not ACK
-	}
-	return 0;
+    uint8_t buf[2] = { (uint8_t)reg, (uint8_t)value };
+    i2c_transaction t = { addr, buf, 2, 0, 0, _priority, I2C_PENDING };
+    if (I2CRun(&t, 1) != 0) {
+        printf("I2C: Communication error on 0x%02x address\n", addr);
+        return -1; // Device did not ACK
+    }
+    return 0;
+}
+
+void TMD3725::set_bus_queue(I2CBusQueue* queue, uint8_t priority)
+{
+	/*
+     * FUNCTION: Use a shared bus queue for all register access
+     * ---------
+     * INPUT: queue - bus queue shared with the other drivers on the same bus, 0 to use the bus directly
+     *        priority - priority of this sensor's transactions [I2C_PRIO_BULK, I2C_PRIO_NORMAL, I2C_PRIO_SENSOR]
+     */
+	_queue = queue;
+	_priority = priority;
 }
 
 bool TMD3725::connected()
@@ -80,174 +104,189 @@ bool TMD3725::connected()
      * RETURN: value at the register is returned
      *         0 - error
      */
-	_i2cPort.beginTransmission(_address);
-	uint8_t retval = _i2cPort.endTransmission();
-	return !retval;
+	i2c_transaction t = { _address, 0, 0, 0, 0, _priority, I2C_PENDING };
+	return I2CRun(&t, 1) == 0;
 }
 
-int TMD3725::set_atime(int reginfo[], int cycle_No) {
+template <typename T>
+int TMD3725::set_atime_t(T reginfo[], int cycle_No) {
     /*
      * FUNCTION: Change the integration time
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        reginfo[35] - current values of all registers
+     * INPUT: reginfo[35] - current values of all registers
      *        cycle_No - integration cycle numbers, must be between 1-256, each cycle takes 2.8ms
      * RETURN: 0 - success
      *         -1 - error
      */
     if ( (cycle_No <= 256) && (cycle_No >= 1) ) {
-        reginfo[1] = cycle_No - 1;
+        reginfo[ATIME_IDX] = cycle_No - 1;
     }
     else 
     	return -1;
-    return I2CSetreg(TMD3725ADDR, ATIME_ADDR, reginfo[1]);
+    return I2CSetreg(TMD3725ADDR, ATIME_ADDR, reginfo[ATIME_IDX]);
+}
+
+int TMD3725::set_atime(int reginfo[], int cycle_No) {
+    return set_atime_t(reginfo, cycle_No);
+}
+
+int TMD3725::set_atime(uint8_t reginfo[], int cycle_No) {
+    return set_atime_t(reginfo, cycle_No);
 }
 
 
+/*
+ * Readable registers as runs of consecutive addresses, in reginfo[] order.
+ * Each run is read with one auto-increment burst. Kept in flash on AVR.
+ */
+static const uint8_t reg_runs[][2] PROGMEM = {
+    { ENABLE_ADDR,    9 },  // ENABLE to PILT
+    { PIHT_ADDR,      1 },
+    { PERS_ADDR,      4 },  // PERS to PCFG1
+    { CFG1_ADDR,      13 }, // CFG1 to PDATA
+    { CFG2_ADDR,      1 },
+    { CFG3_ADDR,      1 },
+    { POFFSETL_ADDR,  2 },  // POFFSETL, POFFSETH
+    { CALIB_ADDR,     1 },
+    { CALIBCFG_ADDR,  1 },
+    { CALIBSTAT_ADDR, 1 },
+    { INTENAB_ADDR,   1 },
+};
+#define REG_RUNS (sizeof(reg_runs) / sizeof(reg_runs[0]))
+
+int TMD3725::get_all_data(uint8_t reginfo[]) {
+    /*
+     * FUNCTION: Read from each register once and stored the values in array 
+     * ---------
+     * INPUT: reginfo[TMD3725_REGCOUNT] - the array used to store all the values from registers
+     * RETURN: 0 - success
+     *         -1 - error
+     *
+     * All runs are handed to the bus as one batch, so a combining backend
+     * (Linux I2C_RDWR) reads the whole register map in a single call.
+     */
+    uint8_t regaddr[REG_RUNS];
+    i2c_transaction t[REG_RUNS];
+    uint8_t k = 0;
+    for (uint8_t i = 0; i < REG_RUNS; i++) {
+        regaddr[i] = pgm_read_byte(&reg_runs[i][0]);
+        t[i].address = TMD3725ADDR;
+        t[i].tx = &regaddr[i];
+        t[i].tx_len = 1;
+        t[i].rx = &reginfo[k];
+        t[i].rx_len = pgm_read_byte(&reg_runs[i][1]);
+        t[i].priority = _priority;
+        t[i].status = I2C_PENDING;
+        k += t[i].rx_len;
+    }
+    if (I2CRun(t, REG_RUNS) != 0) {
+        printf("I2C: No data on 0x%02x address\n", TMD3725ADDR);
+        return -1;
+    }
+    return 0;
+}
+
 int TMD3725::get_all_data(int reginfo[]) {
     /*
      * FUNCTION: Read from each register once and stored the values in array 
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        reginfo[35] - the array used to store all the values from registers, it should have size of 35
+     * INPUT: reginfo[35] - the array used to store all the values from registers, it should have size of 35
      * RETURN: 0 - success
      *         -1 - error
      */
-    /*Enable to PILT*/
-    for (int i=0; i<9; i++) {
-    	reginfo[i] = I2CGetreg(TMD3725ADDR, ENABLE_ADDR+i);
-    	//printf("%d \n", reginfo[i]);
-        if (reginfo[i] == -1) {
-            //printf("Error happens when reading some of ENABLE_ADDR to PILT register value.\n");
-            return -1;
-        }
-    }
-    /*PIHT*/
-    if ((reginfo[9] = I2CGetreg(TMD3725ADDR, PIHT_ADDR)) == -1) {
-        //printf("Error happens when reading register value."); 
+    uint8_t data[TMD3725_REGCOUNT];
+    if (get_all_data(data) != 0) {
         return -1;
     }
-    /*PERS to PCFG1*/
-    for (int i=0; i<4; i++) {
-        if ((reginfo[10+i] = I2CGetreg(TMD3725ADDR, PERS_ADDR+i)) == -1) {
-            //printf("Error happens when reading PIHT register value.\n");
-            return -1;
-        }
-    }
-    /*CFG1 to PDATA*/
-    for (int i=0; i<13; i++) {
-        if ((reginfo[14+i] = I2CGetreg(TMD3725ADDR, CFG1_ADDR+i)) == -1) {
-            //printf("Error happens when reading PDATA register value.\n");
-            return -1;
-        }
-    }
-    /*CFG2*/
-    if ((reginfo[27] = I2CGetreg(TMD3725ADDR, CFG2_ADDR)) == -1) {
-        //printf("Error happens when reading CFG2_ADDR register value.\n"); 
-        return -1;}
-    /*CFG3*/
-    if ((reginfo[28] = I2CGetreg(TMD3725ADDR, CFG3_ADDR)) == -1) {
-        //printf("Error happens when reading CFG3_ADDR register value.\n"); 
-        return -1;}
-    /*POFFSETL*/
-    if ((reginfo[29] = I2CGetreg(TMD3725ADDR, POFFSETL_ADDR)) == -1) {
-        //printf("Error happens when reading POFFSETL_ADDR register value.\n"); 
-        return -1;}
-    /*POFFSETH*/
-    if ((reginfo[30] = I2CGetreg(TMD3725ADDR, POFFSETH_ADDR)) == -1) {
-        //printf("Error happens when reading POFFSETH_ADDR register value.\n"); 
-        return -1;}
-    /*CALIB*/
-    if ((reginfo[31] = I2CGetreg(TMD3725ADDR, CALIB_ADDR)) == -1) {
-        //printf("Error happens when reading CALIB_ADDR register value.\n"); 
-        return -1;}
-    /*CALIBCFG*/
-    if ((reginfo[32] = I2CGetreg(TMD3725ADDR, CALIBCFG_ADDR)) == -1) {
-        //printf("Error happens when reading CALIBCFG_ADDR register value.\n"); 
-        return -1;}
-    /*CALIBSTAT*/
-    if ((reginfo[33] = I2CGetreg(TMD3725ADDR, CALIBSTAT_ADDR)) == -1) {
-        //printf("Error happens when reading CALIBSTAT_ADDR register value.\n"); 
-        return -1;}
-    /*INTENAB*/
-    if ((reginfo[34] = I2CGetreg(TMD3725ADDR, INTENAB_ADDR)) == -1) {
-        //printf("Error happens when reading INTENAB_ADDR register value.\n"); 
-        return -1;}
-    //printf("REG[35]: ");
-    for (unsigned char k = 0; k < 35; k++) {
-        //printf("%02X ", reginfo[k]);
-    }
-    //printf("\n\r");
+    for (uint8_t k = 0; k < TMD3725_REGCOUNT; k++) {
+        reginfo[k] = data[k];
+    }
     return 0;
 }
 
-int TMD3725::set_cfg1(int reginfo[], int IRtoG_flag, int again_flag) {
+template <typename T>
+int TMD3725::set_cfg1_t(T reginfo[], int IRtoG_flag, int again_flag) {
     /*
      * FUNCTION: Change the gain and ir to green setting
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        reginfo[35] - current values of all registers
+     * INPUT: reginfo[35] - current values of all registers
      *        IRtoG_flag - 1 to enable ir to green, 0 to disable ir to green
      *        again_flag - [x1 - gain of 1, x4 - gain of 4, x16 - gain of 16, x64 - gain of 64]
      * RETURN: 0 - success
      *         -1 - error
      */
-    if (IRtoG_flag) { reginfo[14] = reginfo[14] | 0x08; }
-    else { reginfo[14] = reginfo[14] & 0xF7; }
+    tmd3725_cfg1 cfg1;
+    cfg1.reg = reginfo[CFG1_IDX];
+    cfg1.bits.IR_TO_GREEN = IRtoG_flag ? 1 : 0;
     switch (again_flag) {
         case 1:
-            reginfo[14] = reginfo[14] & 0xFC;
+            cfg1.bits.AGAIN = 0;
             break;
         case 4:
-            reginfo[14] = reginfo[14] & 0xFD;
-            reginfo[14] = reginfo[14] | 0x01;
+            cfg1.bits.AGAIN = 1;
             break;
         case 16:
-            reginfo[14] = reginfo[14] & 0xFE;
-            reginfo[14] = reginfo[14] | 0x02;
+            cfg1.bits.AGAIN = 2;
             break;
         case 64:
-            reginfo[14] = reginfo[14] | 0x03;
+            cfg1.bits.AGAIN = 3;
             break;
         default:
-            reginfo[14] = reginfo[14] & 0xFD;
-            reginfo[14] = reginfo[14] | 0x01;
+            cfg1.bits.AGAIN = 1;
     }
-    return I2CSetreg(TMD3725ADDR, CFG1_ADDR, reginfo[14]);
+    reginfo[CFG1_IDX] = cfg1.reg;
+    return I2CSetreg(TMD3725ADDR, CFG1_ADDR, reginfo[CFG1_IDX]);
 }
 
-int TMD3725::enable_sensor(int reginfo[], int wait_flag, int prox_flag, int als_flag) {
+int TMD3725::set_cfg1(int reginfo[], int IRtoG_flag, int again_flag) {
+    return set_cfg1_t(reginfo, IRtoG_flag, again_flag);
+}
+
+int TMD3725::set_cfg1(uint8_t reginfo[], int IRtoG_flag, int again_flag) {
+    return set_cfg1_t(reginfo, IRtoG_flag, again_flag);
+}
+
+template <typename T>
+int TMD3725::enable_sensor_t(T reginfo[], int wait_flag, int prox_flag, int als_flag) {
     /*
      * FUNCTION: Change the enable register settings
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        reginfo[35] - current values of all registers
+     * INPUT: reginfo[35] - current values of all registers
      *        wait_flag - 1 to enable wait feature, 0 to disable wait feature
      *        prox_flag - 1 to enable proximity feature, 0 to disable wait feature
      *        als_flag - 1 to enable als feature, 0 to disable wait feature
      * RETURN: 0 - success
      *         -1 - error
      */
-    if (wait_flag) { reginfo[0] = reginfo[0] | 0x08; }
-    else { reginfo[0] = reginfo[0] & 0xF7; }
-    if (prox_flag) { reginfo[0] = reginfo[0] | 0x04; }
-    else { reginfo[0] = reginfo[0] & 0xFB; }
-    if (als_flag) { reginfo[0] = reginfo[0] | 0x03; }
-    else { reginfo[0] = reginfo[0] & 0xFC; }
-    return I2CSetreg(TMD3725ADDR, ENABLE_ADDR, reginfo[0]);
+    tmd3725_enable enable;
+    enable.reg = reginfo[ENABLE_IDX];
+    enable.bits.WEN = wait_flag ? 1 : 0;
+    enable.bits.PEN = prox_flag ? 1 : 0;
+    enable.bits.AEN = als_flag ? 1 : 0;
+    enable.bits.PON = als_flag ? 1 : 0;
+    reginfo[ENABLE_IDX] = enable.reg;
+    return I2CSetreg(TMD3725ADDR, ENABLE_ADDR, reginfo[ENABLE_IDX]);
 }
 
-int TMD3725::init(int reginfo[]) {
+int TMD3725::enable_sensor(int reginfo[], int wait_flag, int prox_flag, int als_flag) {
+    return enable_sensor_t(reginfo, wait_flag, prox_flag, als_flag);
+}
+
+int TMD3725::enable_sensor(uint8_t reginfo[], int wait_flag, int prox_flag, int als_flag) {
+    return enable_sensor_t(reginfo, wait_flag, prox_flag, als_flag);
+}
+
+template <typename T>
+int TMD3725::init_t(T reginfo[]) {
     /*
      * FUNCTION: TMD3725 initialization
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        reginfo[35] - current values of all registers
+     * INPUT: reginfo[35] - current values of all registers
      * RETURN: 0 - success
      *         -1 - error
      */
 
-    if (set_atime(reginfo, 1) != -1) {
+    if (set_atime_t(reginfo, 1) != -1) {
         //printf("[DEVICE-0x%X]Set integration time to 1 integrated cycles.\n", reginfo[16]);
         //printf("Set integration time to 1 integrated cycles.\n");
     }
@@ -256,7 +295,7 @@ int TMD3725::init(int reginfo[]) {
         return -1;
     }
 
-    if ((set_cfg1(reginfo, 0, x4)) != -1) {
+    if ((set_cfg1_t(reginfo, 0, x4)) != -1) {
         //printf("[DEVICE-0x%X]Set gain to x4.\n", reginfo[16]);
         //printf("[DEVICE-0x]Set gain to x4.\n");
     }
@@ -265,7 +304,7 @@ int TMD3725::init(int reginfo[]) {
         return -1;
     }
     
-    if ((enable_sensor(reginfo, 0, 1, 1)) != -1) {
+    if ((enable_sensor_t(reginfo, 0, 1, 1)) != -1) {
         //printf("[DEVICE-0x%X]Enable color integration cycle.\n", reginfo[16]);
         //printf("[DEVICE-0x]Enable color integration cycle.\n");
     }
@@ -277,26 +316,61 @@ int TMD3725::init(int reginfo[]) {
     return 0;
 }
 
+int TMD3725::init(int reginfo[]) {
+    return init_t(reginfo);
+}
 
-int TMD3725::get_optics_data(int color_array[]) {
+int TMD3725::init(uint8_t reginfo[]) {
+    return init_t(reginfo);
+}
+
+
+int TMD3725::get_optics_data(uint8_t color_array[]) {
     /*
      * FUNCTION: Read from only the color data registers and store the values in array
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        color_array[9] - the array used to store data from only the color data registers
+     * INPUT: color_array[9] - the array used to store data from only the color data registers
      * RETURN: 0 - success
      *         -1 - error
      */
-        //printf("CLR   RED   GRN   BLU   PRX \n");
-  	//          00 00 00 00 00 00 00 00 00 
+    uint8_t regaddr = CDATAL_ADDR;
+    // CDATAL to PDATA, read in one burst so low and high bytes match
+    i2c_transaction t = { TMD3725ADDR, &regaddr, 1, color_array, 9, _priority, I2C_PENDING };
+    if (I2CRun(&t, 1) != 0) {
+        printf("I2C: No data on 0x%02x address, 0x%02x register\n", TMD3725ADDR, CDATAL_ADDR);
+        return -1;
+    }
+    return 0;
+}
+
+int TMD3725::get_optics_data(int color_array[]) {
+    uint8_t data[9];
+    if (get_optics_data(data) != 0) {
+        return -1;
+    }
     for (int i=0; i<9; i++) {
-        if ((color_array[i] = I2CGetreg(TMD3725ADDR, CDATAL_ADDR+i)) == -1) {
-            //printf("Error happens when reading color value.");
-            return -1;
-        }
-        //else printf("%02X ", color_array[i]);
+        color_array[i] = data[i];
     }
-    //printf("\n\r");
+    return 0;
+}
+
+int TMD3725::get_raw_data(tmd3725_raw& raw) {
+    /*
+     * FUNCTION: Read the color data registers into the compact raw sample
+     * ---------
+     * INPUT: raw - struct used to store clear, red, green, blue and proximity data
+     * RETURN: 0 - success
+     *         -1 - error
+     */
+    uint8_t data[9];
+    if (get_optics_data(data) != 0) {
+        return -1;
+    }
+    raw.clear = (data[1] << 8) | data[0];
+    raw.red = (data[3] << 8) | data[2];
+    raw.green = (data[5] << 8) | data[4];
+    raw.blue = (data[7] << 8) | data[6];
+    raw.prox = data[8];
     return 0;
 }
 
@@ -401,42 +475,52 @@ optics_val TMD3725::get_calib_color(const int reginfo[]) {
     /*
      * FUNCTION: Read color data from sensor and caliberate them to usable data
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        reginfo[35] - current values of all registers
+     * INPUT: reginfo[35] - current values of all registers
      * RETURN: calibed - return a struct that contains all the caliberated data
      *         empty struct calibed - return empty calibed if errors occur reading from register
      */
-    int colorarray[9];
+    tmd3725_raw raw;
     optics_val calibed;
-    if ((get_optics_data(colorarray)) == -1) {
+    if ((get_raw_data(raw)) == -1) {
         return calibed;     // if errors occur when reading from register, return empty calibed
     }
-    calibed = calib_color(colorarray, reginfo);     // caliberating ...    
+    calibed = calib_raw(raw, reginfo);     // caliberating ...    
     return calibed;
 }
 
-optics_val TMD3725::calib_color(const int colorarray[], const int reginfo[]) {
+optics_val TMD3725::get_calib_color(const uint8_t reginfo[]) {
+    tmd3725_raw raw;
+    optics_val calibed;
+    if ((get_raw_data(raw)) == -1) {
+        return calibed;
+    }
+    calibed = calib_raw(raw, reginfo);
+    return calibed;
+}
+
+template <typename T>
+optics_val TMD3725::calib_raw(const tmd3725_raw& raw, const T reginfo[]) {
     /*
      * FUNCTION: Caliberate color data with IR channel
      * ---------
-     * INPUT: fd - the file descriptor of the i2c device
-     *        colorarray[9] - values read only from color data registers
+     * INPUT: raw - values read only from color data registers
      *        reginfo[35] - current values of all registers
      * RETURN: calibed - return a struct that contains all the caliberated data
      */
     optics_val calibed;
     int rawr, rawg, rawb, rawc, Again;
     float Atime;
-    rawr = combine_color(colorarray, R);
-    rawg = combine_color(colorarray, G);
-    rawb = combine_color(colorarray, B);
-    rawc = combine_color(colorarray, C);
-    Atime = 2.81 * (reginfo[1] + 1);            // calculate the integration time in ms
-    if (reginfo[11] & 0x02) {
-        Atime = Atime * 12;                     // account for wlong case
-    }
-    Again = power(2.0, (reginfo[14] & 0x03) * 2);   // calculate the gain in 1x, 4x, 16x, 64x
-    if (!(reginfo[27] & 0x04)) {
+    tmd3725_cfg1 cfg1;
+    tmd3725_cfg2 cfg2;
+    rawr = raw.red;
+    rawg = raw.green;
+    rawb = raw.blue;
+    rawc = raw.clear;
+    cfg1.reg = reginfo[CFG1_IDX];
+    cfg2.reg = reginfo[CFG2_IDX];
+    Atime = 2.81 * (reginfo[ATIME_IDX] + 1);    // calculate the integration time in ms, WLONG only scales the wait time
+    Again = power(2.0, cfg1.bits.AGAIN * 2);    // calculate the gain in 1x, 4x, 16x, 64x
+    if (!cfg2.bits.AGAINL) {
         Again = Again/2;                        // account for wider range of gain
     }
     calibed.IR = ((rawr + rawg + rawb) - rawc)/2;
@@ -450,6 +534,27 @@ optics_val TMD3725::calib_color(const int colorarray[], const int reginfo[]) {
     return calibed;
 }
 
+optics_val TMD3725::calib_color(const int colorarray[], const int reginfo[]) {
+    /*
+     * FUNCTION: Caliberate color data with IR channel
+     * ---------
+     * INPUT: colorarray[9] - values read only from color data registers
+     *        reginfo[35] - current values of all registers
+     * RETURN: calibed - return a struct that contains all the caliberated data
+     */
+    tmd3725_raw raw;
+    raw.clear = combine_color(colorarray, C);
+    raw.red = combine_color(colorarray, R);
+    raw.green = combine_color(colorarray, G);
+    raw.blue = combine_color(colorarray, B);
+    raw.prox = colorarray[8];
+    return calib_raw(raw, reginfo);
+}
+
+optics_val TMD3725::calib_color(const tmd3725_raw& raw, const uint8_t reginfo[]) {
+    return calib_raw(raw, reginfo);
+}
+
 int TMD3725::combine_color(const int color_array[], int flag) {
     /*
      * FUNCTION: combine the seperate high bit and low bit color data into 2 bytes color data
@@ -570,3 +675,134 @@ int TMD3725::print_color_json(optics_val color_data, uint32_t timestamp) {
 
     return (hsv_color.h);
 }
+
+void TMD3725::init_deadband(tmd3725_deadband& db, float hue_db, float sat_db, float val_db, float lux_db, uint32_t heartbeat, int delta_flag) {
+    /*
+     * FUNCTION: Set the deadbands of one sensor output and reset its state
+     * ---------
+     * INPUT: db - output state of the sensor
+     *        hue_db, sat_db, val_db, lux_db - a field is emitted when it changes by more than its deadband
+     *        heartbeat - full record at least every heartbeat ms, 0 to disable
+     *        delta_flag - 1 to print only changed fields as deltas, 0 to print full records
+     */
+    db.hue_db = hue_db;
+    db.sat_db = sat_db;
+    db.val_db = val_db;
+    db.lux_db = lux_db;
+    db.heartbeat = heartbeat;
+    db.delta = delta_flag ? 1 : 0;
+    db.valid = 0;
+    db.last_hue = 0;
+    db.last_sat = 0;
+    db.last_val = 0;
+    db.last_lux = 0;
+    db.last_time = 0;
+    db.emitted = 0;
+    db.suppressed = 0;
+}
+
+static float hue_diff(float hue, float last) {
+    // shortest signed angle from last to hue
+    float d = hue - last;
+    if (d > 180) d -= 360;
+    if (d < -180) d += 360;
+    return d;
+}
+
+int TMD3725::deadband_check(tmd3725_deadband& db, optics_val color_data, uint32_t timestamp, hsv& hsv_color) {
+    /*
+     * FUNCTION: Decide which fields of a sample have to be emitted and remember them as the last record
+     * ---------
+     * INPUT: db - output state of the sensor
+     *        color_data - the struct that is storing caliberated color data
+     *        timestamp - current time in ms
+     *        hsv_color - set to the hsv color of the sample
+     * RETURN: DB_HUE, DB_SAT, DB_VAL, DB_LUX flags of the fields to emit, with DB_FULL for a full record
+     *         0 - sample is suppressed
+     */
+    rgb rgb_color;
+    int flags = 0;
+    rgb_color.r = color_data.red/50;
+    rgb_color.g = color_data.green/50;
+    rgb_color.b = color_data.blue/50;
+    hsv_color = rgb2hsv(rgb_color);
+    if (!db.valid || (db.heartbeat && (uint32_t)(timestamp - db.last_time) >= db.heartbeat)) {
+        flags = DB_FULL | DB_HUE | DB_SAT | DB_VAL | DB_LUX;
+        db.valid = 1;
+        db.last_time = timestamp;
+    }
+    else {
+        if (fabs(hue_diff(hsv_color.h, db.last_hue)) > db.hue_db) flags |= DB_HUE;
+        if (fabs(hsv_color.s - db.last_sat) > db.sat_db) flags |= DB_SAT;
+        if (fabs(hsv_color.v - db.last_val) > db.val_db) flags |= DB_VAL;
+        if (fabs(color_data.Lux - db.last_lux) > db.lux_db) flags |= DB_LUX;
+    }
+    if (!flags) {
+        db.suppressed++;
+        return 0;
+    }
+    if (!db.delta) {
+        flags |= DB_HUE | DB_SAT | DB_VAL | DB_LUX;     // full records carry every field
+        db.last_time = timestamp;                       // and restart the heartbeat
+    }
+    // only emitted fields move the reference, so slow drift below the deadband still adds up
+    if (flags & DB_HUE) db.last_hue = hsv_color.h;
+    if (flags & DB_SAT) db.last_sat = hsv_color.s;
+    if (flags & DB_VAL) db.last_val = hsv_color.v;
+    if (flags & DB_LUX) db.last_lux = color_data.Lux;
+    db.emitted++;
+    return flags;
+}
+
+int TMD3725::print_color_delta(tmd3725_deadband& db, optics_val color_data, uint32_t timestamp) {
+    /*
+     * FUNCTION: Print the color in json form only when it changed by more than the deadbands
+     * ---------
+     * INPUT: db - output state of the sensor, see init_deadband()
+     *        color_data - the struct that is storing caliberated color data
+     *        timestamp - current time in ms
+     * RETURN: hue value
+     *         -1 - sample suppressed, nothing printed
+     *
+     * Full records are printed for the first sample, on heartbeat and when
+     * delta mode is off. In delta mode other records hold only the changed
+     * fields as differences to the previous record: dhue, dsaturation,
+     * dvalue, dlux.
+     */
+    hsv hsv_color;
+    float hue = db.last_hue, sat = db.last_sat, val = db.last_val, lux = db.last_lux;
+    int flags = deadband_check(db, color_data, timestamp, hsv_color);
+    if (!flags) {
+        return -1;
+    }
+    printf("{\"timestamp\":\"%lu\"", (unsigned long)timestamp);
+    if ((flags & DB_FULL) || !db.delta) {
+        printf(",\"hue\":\"%.0f\"", hsv_color.h);
+        printf(",\"saturation\":\"%.2f\"", hsv_color.s);
+        printf(",\"value\":\"%.2f\"", hsv_color.v);
+        printf(",\"lux\":\"%.0f\"", color_data.Lux);
+    }
+    else {
+        if (flags & DB_HUE) printf(",\"dhue\":\"%+.0f\"", hue_diff(hsv_color.h, hue));
+        if (flags & DB_SAT) printf(",\"dsaturation\":\"%+.2f\"", hsv_color.s - sat);
+        if (flags & DB_VAL) printf(",\"dvalue\":\"%+.2f\"", hsv_color.v - val);
+        if (flags & DB_LUX) printf(",\"dlux\":\"%+.0f\"", color_data.Lux - lux);
+    }
+    printf("}\n\r");
+
+    return (hsv_color.h);
+}
+
+float TMD3725::suppression_ratio(const tmd3725_deadband& db) {
+    /*
+     * FUNCTION: Share of samples suppressed by the deadband output
+     * ---------
+     * INPUT: db - output state of the sensor
+     * RETURN: suppressed / (emitted + suppressed), 0 before the first sample
+     */
+    uint32_t total = db.emitted + db.suppressed;
+    if (!total) {
+        return 0;
+    }
+    return (float)db.suppressed / total;
+}
@@ -22,7 +22,12 @@
 #ifndef __TMD3725_H
 #define __TMD3725_H
 
+#include <stdint.h>
+#ifdef ARDUINO
 #include <Wire.h>
+#endif
+#include "I2CBusQueue.h"
+#include "LinuxI2CBus.h"
 
 #define TMD3725ADDR 	0x39	// TMD3725 default I2C address
 
@@ -63,6 +68,14 @@
 #define CALIBSTAT_ADDR  0xDC	// R/W
 #define INTENAB_ADDR    0xDD	// R/W
 
+// reginfo[] layout, see get_all_data()
+#define TMD3725_REGCOUNT 35     // number of registers stored in reginfo[]
+#define ENABLE_IDX      0
+#define ATIME_IDX       1
+#define CFG0_IDX        11
+#define CFG1_IDX        14
+#define CFG2_IDX        27
+
 // Gain setting
 #define x1 1
 #define x4 4
@@ -77,6 +90,13 @@
 #define CT_coef     4520    // color temperature coefficient
 #define CT_offset   1804    // color temperature offset
 
+/*deadband changed field flags*/
+#define DB_HUE      0x01
+#define DB_SAT      0x02
+#define DB_VAL      0x04
+#define DB_LUX      0x08
+#define DB_FULL     0x10    // first record or heartbeat, all fields are emitted
+
 /*combine color flag*/
 #define C           1
 #define R           2
@@ -107,6 +127,73 @@ typedef struct {
     double v;       // a fraction between 0 and 1
 } hsv;
 
+typedef struct {
+    // raw color data as read from CDATAL..PDATA, compact alternative to int color_array[9]
+    uint16_t clear;
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+    uint8_t prox;
+} tmd3725_raw;
+
+// Bitfield views of the configuration registers, e.g. tmd3725_cfg1 cfg1; cfg1.reg = reginfo[CFG1_IDX];
+typedef union {
+    uint8_t reg;
+    struct {
+        uint8_t PON : 1;    // power on
+        uint8_t AEN : 1;    // ALS enable
+        uint8_t PEN : 1;    // proximity enable
+        uint8_t WEN : 1;    // wait enable
+        uint8_t     : 4;
+    } bits;
+} tmd3725_enable;
+
+typedef union {
+    uint8_t reg;
+    struct {
+        uint8_t       : 2;
+        uint8_t WLONG : 1;  // wait time x12
+        uint8_t       : 5;
+    } bits;
+} tmd3725_cfg0;
+
+typedef union {
+    uint8_t reg;
+    struct {
+        uint8_t AGAIN       : 2;    // ALS gain 0 - x1, 1 - x4, 2 - x16, 3 - x64
+        uint8_t             : 1;
+        uint8_t IR_TO_GREEN : 1;    // IR sensor mapped to the green channel
+        uint8_t             : 4;
+    } bits;
+} tmd3725_cfg1;
+
+typedef union {
+    uint8_t reg;
+    struct {
+        uint8_t        : 2;
+        uint8_t AGAINL : 1; // full ALS gain range, halved gain when 0
+        uint8_t        : 5;
+    } bits;
+} tmd3725_cfg2;
+
+typedef struct {
+    // deadband output state of one sensor, keep one per sensor and set it up with init_deadband()
+    float hue_db;           // minimum hue change in degrees that is emitted
+    float sat_db;           // minimum saturation change (0..1)
+    float val_db;           // minimum value change (0..1)
+    float lux_db;           // minimum lux change
+    uint32_t heartbeat;     // emit a full record at least every heartbeat ms, 0 - no heartbeat
+    uint8_t delta;          // 1 - print changed fields as deltas against the last record
+    uint8_t valid;          // last_* hold an emitted record
+    float last_hue;
+    float last_sat;
+    float last_val;
+    float last_lux;
+    uint32_t last_time;     // timestamp of the last full record, every emitted record is full when delta is 0
+    uint32_t emitted;       // number of records emitted
+    uint32_t suppressed;    // number of samples suppressed
+} tmd3725_deadband;
+
 //extern hsv hsv_color;
 //extern rgb rgb_color;
 
@@ -114,14 +201,47 @@ class TMD3725
 {
 private:
 	uint8_t _address;
-	TwoWire& _i2cPort;
-	uint8_t _controlRegister;
+#ifdef ARDUINO
+	TwoWireBus _wireBus;
+#endif
+	I2CBus* _bus;
+	I2CBusQueue* _queue;
+	uint8_t _priority;
 	int I2CGetreg(uint8_t addr, int reg);
 	int I2CSetreg (uint8_t addr, int reg, int value);
+	int I2CRun(i2c_transaction t[], uint8_t n);
+	template <typename T> int set_atime_t(T reginfo[], int cycle_No);
+	template <typename T> int set_cfg1_t(T reginfo[], int IRtoG_flag, int again_flag);
+	template <typename T> int enable_sensor_t(T reginfo[], int wait_flag, int prox_flag, int als_flag);
+	template <typename T> int init_t(T reginfo[]);
+	template <typename T> optics_val calib_raw(const tmd3725_raw& raw, const T reginfo[]);
 
 public:
-	TMD3725(TwoWire& i2cPort = Wire) : _i2cPort(i2cPort)
+#ifdef ARDUINO
+	TMD3725(TwoWire& i2cPort = Wire) : _wireBus(i2cPort), _bus(&_wireBus), _queue(0), _priority(I2C_PRIO_SENSOR)
+	{
+	}
+#endif
+	TMD3725(I2CBus& bus) : _bus(&bus), _queue(0), _priority(I2C_PRIO_SENSOR)
+	{
+	}
+	TMD3725(const TMD3725& other)
 	{
+		*this = other;
+	}
+	TMD3725& operator=(const TMD3725& other)
+	{
+		// a copy made from a TwoWire port must use its own _wireBus, not the source's
+		_address = other._address;
+#ifdef ARDUINO
+		_wireBus = other._wireBus;
+		_bus = (other._bus == &other._wireBus) ? &_wireBus : other._bus;
+#else
+		_bus = other._bus;
+#endif
+		_queue = other._queue;
+		_priority = other._priority;
+		return *this;
 	}
 
 	bool begin(uint8_t address = TMD3725ADDR)
@@ -130,6 +250,7 @@ public:
 		return connected();
 	}
 
+	void set_bus_queue(I2CBusQueue* queue, uint8_t priority = I2C_PRIO_SENSOR); // route all register access through a shared bus queue, 0 to use the bus directly
 	bool connected(); // check if TMD3725 present on 0x39 I2C address
 	int set_atime(int reginfo[], int cycle_No); // Set integration time
 	int set_cfg1(int reginfo[], int IRtoG_flag, int again_flag); // set the gain and IR to GREEN settings
@@ -143,6 +264,17 @@ public:
 	optics_val calib_color(const int colorarray[], const int reginfo[]); // caliberate color data with IR channel
 	optics_val get_calib_color(const int reginfo[]); // get data from the sensor and calibrate it
 
+	// Byte-sized register storage, uint8_t reginfo[TMD3725_REGCOUNT] instead of int reginfo[35]
+	int set_atime(uint8_t reginfo[], int cycle_No);
+	int set_cfg1(uint8_t reginfo[], int IRtoG_flag, int again_flag);
+	int enable_sensor(uint8_t reginfo[], int wait_flag, int prox_flag, int als_flag);
+	int init(uint8_t reginfo[]);
+	int get_all_data(uint8_t reginfo[]);
+	int get_optics_data(uint8_t color_array[]);
+	int get_raw_data(tmd3725_raw& raw); // get color data registers into the compact raw sample
+	optics_val calib_color(const tmd3725_raw& raw, const uint8_t reginfo[]);
+	optics_val get_calib_color(const uint8_t reginfo[]);
+
 	float power(float base, int power); // power math function
 	hsv rgb2hsv(rgb in); // convert rgb color structure to hsv color format
 	rgb hsv2rgb(hsv in); // convert hsv color structure to rgb color format
@@ -151,6 +283,11 @@ public:
 	int return_Brightness(optics_val color_data);    // get brightness value from the sensor color data
 	int return_Brigtness(optics_val color_data);    // get color data from the sensor and print it to stdout in rgb and hsv formats
 	int print_color_json(optics_val color_data, uint32_t timestamp); // get color data from the sensor and print it to stdout in json format
+
+	void init_deadband(tmd3725_deadband& db, float hue_db, float sat_db, float val_db, float lux_db, uint32_t heartbeat, int delta_flag); // set deadbands and reset output state
+	int deadband_check(tmd3725_deadband& db, optics_val color_data, uint32_t timestamp, hsv& hsv_color); // return DB_* flags of fields to emit, 0 - suppress
+	int print_color_delta(tmd3725_deadband& db, optics_val color_data, uint32_t timestamp); // print json only when a deadband is exceeded or the heartbeat expires
+	float suppression_ratio(const tmd3725_deadband& db); // fraction of samples suppressed so far
 };
 
 #endif // __TMD3725_H